@@ -0,0 +1,591 @@
+#define _POSIX_C_SOURCE 200809L
+#include "bulk_io.h"
+#include "trace.h"
+#include <pthread.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 传输任务状态
+enum {
+    JOB_PENDING,
+    JOB_DONE,
+    JOB_FAILED
+};
+
+// 单个文件的传输任务
+typedef struct {
+    char host_path[HOST_PATH_MAX];   // 宿主机路径
+    char name[MAX_FILENAME];         // 镜像内文件名
+    char data[MAX_FILE_SIZE];        // 文件内容
+    size_t size;                     // 文件大小
+    int state;                       // 任务状态
+    const char* error;               // 失败原因
+} transfer_job_t;
+
+// 工作线程共享的任务队列
+typedef struct {
+    transfer_job_t* jobs;
+    int job_count;
+    int job_capacity;
+    int next_job;                    // 下一个待领取的任务
+    int job_limit;                   // 最多收集的任务数, 负数表示不限
+    const dir_entry_t* entries;      // 导入时的根目录项, 用于跳过已存在的文件
+    int entry_count;
+    int skipped_full;                // 因目录已满而跳过的文件数
+    int skipped_exist;               // 因同名文件已存在而跳过的文件数
+    int (*work)(transfer_job_t* job);
+    pthread_mutex_t lock;
+    pthread_cond_t done;             // 有任务完成时广播
+} transfer_queue_t;
+
+/**
+ * 向队列追加一个任务
+ */
+static transfer_job_t* add_job(transfer_queue_t* q, const char* host_path, const char* name) {
+    if (strlen(name) >= MAX_FILENAME) {
+        printf("错误: 文件名 '%s' 过长, 跳过\n", name);
+        return NULL;
+    }
+    if (strlen(host_path) >= HOST_PATH_MAX) {
+        printf("错误: 路径 '%s' 过长, 跳过\n", host_path);
+        return NULL;
+    }
+    
+    if (q->job_count == q->job_capacity) {
+        int capacity = q->job_capacity ? q->job_capacity * 2 : 16;
+        transfer_job_t* jobs = realloc(q->jobs, capacity * sizeof(transfer_job_t));
+        if (!jobs) {
+            printf("错误: 内存不足\n");
+            return NULL;
+        }
+        q->jobs = jobs;
+        q->job_capacity = capacity;
+    }
+    
+    transfer_job_t* job = &q->jobs[q->job_count++];
+    memset(job, 0, sizeof(transfer_job_t));
+    strcpy(job->host_path, host_path);
+    strcpy(job->name, name);
+    job->state = JOB_PENDING;
+    return job;
+}
+
+/**
+ * 递归收集宿主机上的普通文件
+ * 目录中指向目录的符号链接不会展开, 避免链接成环时重复导入同一批文件
+ */
+static void collect_host_path(transfer_queue_t* q, const char* host_path, const char* name) {
+    struct stat st;
+    if (stat(host_path, &st) < 0) {
+        printf("错误: 无法访问 '%s'\n", host_path);
+        return;
+    }
+    
+    if (S_ISREG(st.st_mode)) {
+        for (int i = 0; i < q->entry_count; i++) {
+            if (q->entries[i].inode != 0 && strcmp(q->entries[i].name, name) == 0) {
+                q->skipped_exist++;
+                return;
+            }
+        }
+        
+        // 过大或不可读的文件在这里就排除, 不占用目录槽位
+        if (st.st_size > MAX_FILE_SIZE) {
+            printf("错误: 无法导入 '%s': 超过最大文件大小\n", host_path);
+            return;
+        }
+        if (access(host_path, R_OK) < 0) {
+            printf("错误: 无法导入 '%s': 无法打开文件\n", host_path);
+            return;
+        }
+        
+        // 目录已满后只计数, 不再读取文件内容
+        if (q->job_limit >= 0 && q->job_count >= q->job_limit) {
+            q->skipped_full++;
+            return;
+        }
+        add_job(q, host_path, name);
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return; // 跳过设备、管道等特殊文件
+    }
+    
+    DIR* dir = opendir(host_path);
+    if (!dir) {
+        printf("错误: 无法打开目录 '%s'\n", host_path);
+        return;
+    }
+    
+    struct dirent* de;
+    while ((de = readdir(dir)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+            continue;
+        }
+        
+        char child_path[HOST_PATH_MAX * 2];
+        char child_name[HOST_PATH_MAX * 2];
+        snprintf(child_path, sizeof(child_path), "%s/%s", host_path, de->d_name);
+        
+        struct stat link_st;
+        if (lstat(child_path, &link_st) == 0 && S_ISLNK(link_st.st_mode) &&
+            stat(child_path, &st) == 0 && S_ISDIR(st.st_mode)) {
+            printf("跳过指向目录的符号链接 '%s'\n", child_path);
+            continue;
+        }
+        if (name[0]) {
+            snprintf(child_name, sizeof(child_name), "%s/%s", name, de->d_name);
+        } else {
+            snprintf(child_name, sizeof(child_name), "%s", de->d_name);
+        }
+        collect_host_path(q, child_path, child_name);
+    }
+    closedir(dir);
+}
+
+/**
+ * 逐级创建目录, include_last为0时不创建最后一级 (最后一级是文件名)
+ */
+static int make_dirs(const char* path, int include_last) {
+    char partial[HOST_PATH_MAX];
+    snprintf(partial, sizeof(partial), "%s", path);
+    
+    for (char* p = partial + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdir(partial, 0755) < 0 && errno != EEXIST) {
+                return -1;
+            }
+            *p = '/';
+        }
+    }
+    if (include_last && mkdir(partial, 0755) < 0 && errno != EEXIST) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * 判断镜像内文件名拼接到宿主目录后是否会越出该目录 (绝对路径或含有".."路径分量)
+ */
+static int escapes_host_dir(const char* name) {
+    if (name[0] == '/') {
+        return 1;
+    }
+    
+    const char* p = name;
+    while (*p) {
+        size_t len = strcspn(p, "/");
+        if (len == 2 && p[0] == '.' && p[1] == '.') {
+            return 1;
+        }
+        p += len;
+        if (*p == '/') {
+            p++;
+        }
+    }
+    return 0;
+}
+
+/**
+ * 工作线程: 领取任务并执行, 完成后通知等待者
+ */
+static void* transfer_worker(void* arg) {
+    transfer_queue_t* q = arg;
+    
+    while (1) {
+        pthread_mutex_lock(&q->lock);
+        int index = q->next_job++;
+        pthread_mutex_unlock(&q->lock);
+        if (index >= q->job_count) {
+            break;
+        }
+        
+        transfer_job_t* job = &q->jobs[index];
+        int state = q->work(job);
+        
+        pthread_mutex_lock(&q->lock);
+        job->state = state;
+        pthread_cond_broadcast(&q->done);
+        pthread_mutex_unlock(&q->lock);
+    }
+    return NULL;
+}
+
+/**
+ * 启动工作线程, 返回实际启动的线程数
+ */
+static int start_workers(transfer_queue_t* q, pthread_t* threads) {
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->done, NULL);
+    
+    int count = 0;
+    while (count < TRANSFER_THREADS && count < q->job_count) {
+        if (pthread_create(&threads[count], NULL, transfer_worker, q) != 0) {
+            break;
+        }
+        count++;
+    }
+    
+    // 一个线程都没启动时在当前线程完成所有任务
+    if (count == 0) {
+        transfer_worker(q);
+    }
+    return count;
+}
+
+/**
+ * 等待工作线程结束并释放队列
+ */
+static void finish_workers(transfer_queue_t* q, pthread_t* threads, int count) {
+    for (int i = 0; i < count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->done);
+    free(q->jobs);
+}
+
+/**
+ * 读取宿主文件内容 (导入阶段一)
+ */
+static int read_host_file(transfer_job_t* job) {
+    FILE* file = fopen(job->host_path, "rb");
+    if (!file) {
+        job->error = "无法打开文件";
+        return JOB_FAILED;
+    }
+    
+    job->size = fread(job->data, 1, MAX_FILE_SIZE, file);
+    int too_large = (job->size == MAX_FILE_SIZE && fgetc(file) != EOF);
+    fclose(file);
+    
+    if (too_large) {
+        job->error = "超过最大文件大小";
+        return JOB_FAILED;
+    }
+    return JOB_DONE;
+}
+
+/**
+ * 写出宿主文件内容
+ */
+static int write_host_file(transfer_job_t* job) {
+    if (make_dirs(job->host_path, 0) < 0) {
+        job->error = "无法创建目录";
+        return JOB_FAILED;
+    }
+    
+    FILE* file = fopen(job->host_path, "wb");
+    if (!file) {
+        job->error = "无法创建文件";
+        return JOB_FAILED;
+    }
+    
+    size_t written = fwrite(job->data, 1, job->size, file);
+    if (fclose(file) != 0 || written != job->size) {
+        job->error = "写入失败";
+        return JOB_FAILED;
+    }
+    return JOB_DONE;
+}
+
+/**
+ * 提交一批已读入内存的文件 (导入阶段二、三)
+ * 整批文件一次性分配数据块, 数据按分配顺序排进暂存区后,
+ * 物理上连续的块合并成一次写入; 先写数据, 再写inode, 目录最后由调用者写回
+ */
+static int commit_batch(transfer_job_t** batch, int count, dir_entry_t* entries, int entry_count) {
+    transfer_job_t* files[IMPORT_BATCH_FILES];
+    int inode_nums[IMPORT_BATCH_FILES];
+    int slots[IMPORT_BATCH_FILES];
+    int accepted = 0;
+    int total_blocks = 0;
+    
+    for (int k = 0; k < count; k++) {
+        transfer_job_t* job = batch[k];
+        int free_slot = -1;
+        int exists = 0;
+        
+        for (int i = 0; i < entry_count; i++) {
+            if (entries[i].inode != 0) {
+                if (strcmp(entries[i].name, job->name) == 0) {
+                    exists = 1;
+                    break;
+                }
+            } else if (free_slot == -1) {
+                free_slot = i;
+            }
+        }
+        
+        if (exists) {
+            printf("错误: 文件 '%s' 已存在, 跳过\n", job->name);
+            continue;
+        }
+        if (free_slot == -1) {
+            printf("错误: 目录已满, 跳过 '%s'\n", job->name);
+            continue;
+        }
+        
+        int inode_num = alloc_inode();
+        if (inode_num < 0) {
+            printf("错误: 没有可用的inode, 跳过 '%s'\n", job->name);
+            continue;
+        }
+        
+        // 先占用目录槽位, 避免同批后续文件重复使用
+        entries[free_slot].inode = inode_num;
+        strncpy(entries[free_slot].name, job->name, MAX_FILENAME - 1);
+        entries[free_slot].name[MAX_FILENAME - 1] = '\0';
+        
+        files[accepted] = job;
+        inode_nums[accepted] = inode_num;
+        slots[accepted] = free_slot;
+        accepted++;
+        total_blocks += (job->size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+    
+    int blocks[IMPORT_BATCH_FILES * 8];
+    char* staging = calloc(total_blocks > 0 ? total_blocks : 1, BLOCK_SIZE);
+    if (!staging || alloc_blocks(total_blocks, blocks) < 0) {
+        printf("错误: %s, 本批 %d 个文件未导入\n", staging ? "磁盘空间不足" : "内存不足", accepted);
+        for (int k = 0; k < accepted; k++) {
+            free_inode(inode_nums[k]);
+            memset(&entries[slots[k]], 0, sizeof(dir_entry_t));
+        }
+        free(staging);
+        return 0;
+    }
+    
+    // 组装inode, 并把文件数据排进暂存区
+    inode_t inodes[IMPORT_BATCH_FILES];
+    int next = 0;
+    for (int k = 0; k < accepted; k++) {
+        memset(&inodes[k], 0, sizeof(inode_t));
+        inodes[k].type = 1;
+        inodes[k].links = 1;
+        inodes[k].size = files[k]->size;
+        
+        memcpy(staging + next * BLOCK_SIZE, files[k]->data, files[k]->size);
+        for (int i = 0; i * BLOCK_SIZE < (int)files[k]->size; i++) {
+            inodes[k].blocks[i] = blocks[next++];
+        }
+    }
+    
+    // 合并写入物理连续的数据块
+    for (int start = 0; start < total_blocks; ) {
+        int len = 1;
+        while (start + len < total_blocks && blocks[start + len] == blocks[start + len - 1] + 1) {
+            len++;
+        }
+        disk_write_blocks(blocks[start], len, staging + start * BLOCK_SIZE);
+        start += len;
+    }
+    free(staging);
+    
+    // 每个导入的文件在跟踪日志中记为一次创建加一次写入, 回放时可重建相同的文件
+    for (int k = 0; k < accepted; k++) {
+        write_inode(inode_nums[k], &inodes[k]);
+        trace_log(TRACE_CREATE, files[k]->name, NULL, 0, 0);
+        trace_log(TRACE_WRITE, files[k]->name, NULL, files[k]->size, 0);
+    }
+    return accepted;
+}
+
+/**
+ * 从宿主机导入文件或目录树
+ * 阶段一: 工作线程并行读取宿主文件; 阶段二: 按批分配连续数据块;
+ * 阶段三: 合并写入镜像. 主线程按顺序消费已读完的文件, 与后续读取重叠进行
+ */
+int import_path(const char* host_path, const char* dest) {
+    struct stat st;
+    if (stat(host_path, &st) < 0) {
+        printf("错误: 无法访问 '%s'\n", host_path);
+        return -1;
+    }
+    
+    // 目标名: 单个文件默认取宿主文件名, 目录默认直接展开到根目录
+    char name[HOST_PATH_MAX] = "";
+    if (dest && dest[0]) {
+        snprintf(name, sizeof(name), "%s", dest);
+    } else if (S_ISREG(st.st_mode)) {
+        const char* base = strrchr(host_path, '/');
+        snprintf(name, sizeof(name), "%s", base ? base + 1 : host_path);
+    }
+    
+    // 读取根目录, 整个导入结束后写回一次
+    inode_t root_inode;
+    read_inode(0, &root_inode);
+    
+    char root_data[BLOCK_SIZE];
+    disk_read_block(root_inode.blocks[0], root_data);
+    
+    dir_entry_t* entries = (dir_entry_t*)root_data;
+    int entry_count = BLOCK_SIZE / sizeof(dir_entry_t);
+    
+    // 最多只收集目录空槽位数 (且不超过空闲inode数) 个文件
+    int free_slots = 0;
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].inode == 0) {
+            free_slots++;
+        }
+    }
+    if ((uint32_t)free_slots > fs.superblock.free_inode_count) {
+        free_slots = fs.superblock.free_inode_count;
+    }
+    
+    transfer_queue_t q = {0};
+    q.job_limit = free_slots;
+    q.entries = entries;
+    q.entry_count = entry_count;
+    collect_host_path(&q, host_path, name);
+    
+    if (q.skipped_exist > 0) {
+        printf("跳过 %d 个已存在的文件\n", q.skipped_exist);
+    }
+    if (q.skipped_full > 0) {
+        printf("目录已满, 跳过 %d 个文件\n", q.skipped_full);
+    }
+    if (q.job_count == 0) {
+        printf("没有可导入的文件\n");
+        free(q.jobs);
+        return 0;
+    }
+    
+    q.work = read_host_file;
+    pthread_t threads[TRANSFER_THREADS];
+    int thread_count = start_workers(&q, threads);
+    
+    transfer_job_t* batch[IMPORT_BATCH_FILES];
+    int batch_count = 0;
+    int imported = 0;
+    
+    for (int i = 0; i < q.job_count; i++) {
+        transfer_job_t* job = &q.jobs[i];
+        
+        pthread_mutex_lock(&q.lock);
+        while (job->state == JOB_PENDING) {
+            pthread_cond_wait(&q.done, &q.lock);
+        }
+        pthread_mutex_unlock(&q.lock);
+        
+        if (job->state == JOB_FAILED) {
+            printf("错误: 无法导入 '%s': %s\n", job->host_path, job->error);
+            continue;
+        }
+        
+        batch[batch_count++] = job;
+        if (batch_count == IMPORT_BATCH_FILES) {
+            imported += commit_batch(batch, batch_count, entries, entry_count);
+            batch_count = 0;
+        }
+    }
+    if (batch_count > 0) {
+        imported += commit_batch(batch, batch_count, entries, entry_count);
+    }
+    
+    finish_workers(&q, threads, thread_count);
+    
+    // 写回根目录数据块
+    disk_write_block(root_inode.blocks[0], root_data);
+    
+    printf("从 '%s' 导入了 %d 个文件\n", host_path, imported);
+    return imported;
+}
+
+/**
+ * 导出文件到宿主机
+ * 主线程按连续区段合并读取镜像, 工作线程并行写出宿主文件
+ */
+int export_path(const char* src, const char* host_path) {
+    inode_t root_inode;
+    read_inode(0, &root_inode);
+    
+    char root_data[BLOCK_SIZE];
+    disk_read_block(root_inode.blocks[0], root_data);
+    
+    dir_entry_t* entries = (dir_entry_t*)root_data;
+    int entry_count = BLOCK_SIZE / sizeof(dir_entry_t);
+    int export_all = (strcmp(src, "/") == 0);
+    
+    struct stat st;
+    int host_is_dir = export_all || (stat(host_path, &st) == 0 && S_ISDIR(st.st_mode));
+    
+    transfer_queue_t q = {0};
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].inode == 0 || (!export_all && strcmp(entries[i].name, src) != 0)) {
+            continue;
+        }
+        
+        inode_t file_inode;
+        read_inode(entries[i].inode, &file_inode);
+        if (file_inode.type != 1) {
+            continue;
+        }
+        
+        char path[HOST_PATH_MAX * 2];
+        if (host_is_dir) {
+            if (escapes_host_dir(entries[i].name)) {
+                printf("错误: 文件名 '%s' 会越出目录 '%s', 跳过\n", entries[i].name, host_path);
+                continue;
+            }
+            snprintf(path, sizeof(path), "%s/%s", host_path, entries[i].name);
+        } else {
+            snprintf(path, sizeof(path), "%s", host_path);
+        }
+        
+        transfer_job_t* job = add_job(&q, path, entries[i].name);
+        if (!job) {
+            continue;
+        }
+        
+        // 读取文件的全部数据块, 物理连续的块合并读取
+        int block_count = 0;
+        while (block_count < 8 && file_inode.blocks[block_count] != 0) {
+            block_count++;
+        }
+        trace_log(TRACE_READ, entries[i].name, NULL, file_inode.size, 0);
+        disk_read_block_list(file_inode.blocks, block_count, job->data);
+        job->size = file_inode.size;
+    }
+    
+    if (q.job_count == 0) {
+        free(q.jobs);
+        if (!export_all) {
+            printf("错误: 文件 '%s' 不存在\n", src);
+            return -1;
+        }
+        printf("没有可导出的文件\n");
+        return 0;
+    }
+    
+    if (export_all && make_dirs(host_path, 1) < 0) {
+        printf("错误: 无法创建目录 '%s'\n", host_path);
+        free(q.jobs);
+        return -1;
+    }
+    
+    q.work = write_host_file;
+    pthread_t threads[TRANSFER_THREADS];
+    int thread_count = start_workers(&q, threads);
+    
+    // 等待写出全部完成后统计结果
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    int exported = 0;
+    for (int i = 0; i < q.job_count; i++) {
+        if (q.jobs[i].state == JOB_DONE) {
+            exported++;
+        } else {
+            printf("错误: 无法导出 '%s': %s\n", q.jobs[i].host_path, q.jobs[i].error);
+        }
+    }
+    finish_workers(&q, threads, 0);
+    
+    printf("导出了 %d 个文件到 '%s'\n", exported, host_path);
+    return exported;
+}
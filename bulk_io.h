@@ -0,0 +1,16 @@
+#ifndef BULK_IO_H
+#define BULK_IO_H
+
+#include "file_ops.h"
+
+#define TRANSFER_THREADS 4       // 读写宿主文件的工作线程数
+#define IMPORT_BATCH_FILES 8     // 每批分配数据块的文件数
+#define HOST_PATH_MAX 512
+
+// 从宿主机导入文件或目录树, dest为空时使用宿主文件名, 返回导入的文件数
+int import_path(const char *host_path, const char *dest);
+
+// 导出文件到宿主机, src为"/"时将整个镜像导出到host_path目录, 返回导出的文件数
+int export_path(const char *src, const char *host_path);
+
+#endif
@@ -0,0 +1,316 @@
+#include "defrag.h"
+#include "trace.h"
+
+/**
+ * 统计文件的数据块数和区段数 (物理上连续的一段块算一个区段)
+ */
+static int count_extents(const inode_t* inode, int* block_count) {
+    int extents = 0;
+    int blocks = 0;
+    for (int i = 0; i < 8 && inode->blocks[i] != 0; i++) {
+        if (i == 0 || inode->blocks[i] != inode->blocks[i - 1] + 1) {
+            extents++;
+        }
+        blocks++;
+    }
+    if (block_count) {
+        *block_count = blocks;
+    }
+    return extents;
+}
+
+/**
+ * 统计空闲区段数和最大连续空闲块数
+ */
+static int count_free_extents(int* largest_free) {
+    int free_extents = 0;
+    int largest = 0;
+    int run_len = 0;
+    for (int i = 0; i < DATA_BLOCKS; i++) {
+        if (!(fs.data_bitmap[i / 8] & (1 << (i % 8)))) {
+            if (run_len++ == 0) {
+                free_extents++;
+            }
+            if (run_len > largest) {
+                largest = run_len;
+            }
+        } else {
+            run_len = 0;
+        }
+    }
+    if (largest_free) {
+        *largest_free = largest;
+    }
+    return free_extents;
+}
+
+/**
+ * 显示碎片情况
+ */
+int show_fragmentation() {
+    inode_t root_inode;
+    read_inode(0, &root_inode);
+    
+    char root_data[BLOCK_SIZE];
+    disk_read_block(root_inode.blocks[0], root_data);
+    
+    dir_entry_t* entries = (dir_entry_t*)root_data;
+    int entry_count = BLOCK_SIZE / sizeof(dir_entry_t);
+    int file_count = 0;
+    int fragmented_count = 0;
+    int total_blocks = 0;
+    int total_extents = 0;
+    
+    printf("文件碎片情况:\n");
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].inode == 0) {
+            continue;
+        }
+        
+        inode_t file_inode;
+        read_inode(entries[i].inode, &file_inode);
+        
+        int blocks;
+        int extents = count_extents(&file_inode, &blocks);
+        printf("  %-20s [块数: %d, 区段数: %d]%s\n", entries[i].name, blocks, extents,
+               extents > 1 ? " 有碎片" : "");
+        
+        file_count++;
+        total_blocks += blocks;
+        total_extents += extents;
+        if (extents > 1) {
+            fragmented_count++;
+        }
+    }
+    
+    int largest_free;
+    int free_extents = count_free_extents(&largest_free);
+    
+    printf("\n镜像碎片情况:\n");
+    printf("  文件数: %d (有碎片: %d)\n", file_count, fragmented_count);
+    printf("  数据块数: %d, 区段数: %d\n", total_blocks, total_extents);
+    printf("  空闲区段数: %d, 最大连续空闲块数: %d\n", free_extents, largest_free);
+    printf("\n");
+    return 0;
+}
+
+// 整理过程中可移动的文件: 只属于一个普通文件的数据块才能移动
+typedef struct {
+    const char* name;
+    int inode_num;
+    inode_t inode;
+    int blocks;
+    int first;                         // 当前最低的数据块下标
+} movable_file_t;
+
+static int block_used(int index) {
+    return fs.data_bitmap[index / 8] & (1 << (index % 8));
+}
+
+/**
+ * 把文件第slot个数据块搬到空闲的数据块dst (数据区下标)
+ * 顺序: 占用新块 -> 复制数据 -> 写回inode -> 释放旧块,
+ * 任何一步中断都不会丢失数据, 最多泄漏尚未释放的块
+ */
+static void move_block(movable_file_t* file, int slot, int dst, movable_file_t** owners) {
+    int old_block = file->inode.blocks[slot];
+    int new_block = DATA_START_BLOCK + dst;
+    
+    char data[BLOCK_SIZE];
+    alloc_block_at(new_block);
+    disk_read_block(old_block, data);
+    disk_write_block(new_block, data);
+    
+    file->inode.blocks[slot] = new_block;
+    write_inode(file->inode_num, &file->inode);
+    free_block(old_block);
+    
+    owners[old_block - DATA_START_BLOCK] = NULL;
+    owners[dst] = file;
+}
+
+/**
+ * 查找一个空闲数据块用来腾出dst: 优先取from之后的, 没有时取其他任意空闲块
+ */
+static int find_spare_block(int from, int dst) {
+    for (int i = from; i < DATA_BLOCKS; i++) {
+        if (!block_used(i)) {
+            return i;
+        }
+    }
+    for (int i = 0; i < from && i < DATA_BLOCKS; i++) {
+        if (i != dst && !block_used(i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * 把文件搬到从start开始的连续区域, 区域中其他文件的块先搬到别处
+ * 返回文件是否移动过, 没有可用的空闲块时返回-1
+ */
+static int compact_file(movable_file_t* file, int start, movable_file_t** owners) {
+    int moved = 0;
+    for (int slot = 0; slot < file->blocks; slot++) {
+        int dst = start + slot;
+        if ((int)file->inode.blocks[slot] == DATA_START_BLOCK + dst) {
+            continue;
+        }
+        
+        // 目标块被占用时先把占用者 (其他文件或本文件后面的块) 挪开
+        movable_file_t* owner = owners[dst];
+        if (owner) {
+            int spare = find_spare_block(start + file->blocks, dst);
+            if (spare < 0) {
+                return -1;
+            }
+            int owner_slot = 0;
+            while ((int)owner->inode.blocks[owner_slot] != DATA_START_BLOCK + dst) {
+                owner_slot++;
+            }
+            move_block(owner, owner_slot, spare, owners);
+        }
+        
+        move_block(file, slot, dst, owners);
+        moved = 1;
+    }
+    return moved;
+}
+
+/**
+ * 整理碎片: 按物理位置从低到高把每个文件依次移到最低的空闲位置,
+ * 后面的文件向前滑动填补空洞, 整理后文件各自连续且空闲空间集中在数据区末尾
+ */
+int defrag_disk(int budget_ms) {
+    trace_log(TRACE_DEFRAG, NULL, NULL, budget_ms, 0);
+    
+    inode_t root_inode;
+    read_inode(0, &root_inode);
+    
+    char root_data[BLOCK_SIZE];
+    disk_read_block(root_inode.blocks[0], root_data);
+    
+    dir_entry_t* entries = (dir_entry_t*)root_data;
+    int entry_count = BLOCK_SIZE / sizeof(dir_entry_t);
+    uint64_t deadline = trace_now_ns() + (uint64_t)budget_ms * 1000000ULL;
+    
+    // 上次未完成时从保存在超级块中的位置继续, 之前的部分已经整理完毕
+    int cursor = fs.superblock.defrag_cursor;
+    if (cursor >= DATA_BLOCKS) {
+        cursor = 0;
+    }
+    
+    printf("开始整理碎片:\n");
+    
+    // 收集可移动的文件, 记录每个数据块属于哪个文件
+    // 与克隆文件共享数据块的文件和根目录块固定不动
+    static movable_file_t* owners[DATA_BLOCKS];
+    movable_file_t files[BLOCK_SIZE / sizeof(dir_entry_t)];
+    int file_count = 0;
+    memset(owners, 0, sizeof(owners));
+    
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].inode == 0) {
+            continue;
+        }
+        
+        movable_file_t* file = &files[file_count];
+        read_inode(entries[i].inode, &file->inode);
+        count_extents(&file->inode, &file->blocks);
+        if (file->inode.type != 1 || file->blocks == 0) {
+            continue;
+        }
+        
+        int shared = 0;
+        file->first = DATA_BLOCKS;
+        for (int b = 0; b < file->blocks; b++) {
+            int index = file->inode.blocks[b] - DATA_START_BLOCK;
+            shared |= (fs.block_refs[index] > 1);
+            if (index < file->first) {
+                file->first = index;
+            }
+        }
+        if (shared) {
+            printf("  固定 '%s': 与其他文件共享数据块\n", entries[i].name);
+            continue;
+        }
+        if (file->first < cursor) {
+            continue; // 已在之前的整理中处理过
+        }
+        
+        file->name = entries[i].name;
+        file->inode_num = entries[i].inode;
+        for (int b = 0; b < file->blocks; b++) {
+            owners[file->inode.blocks[b] - DATA_START_BLOCK] = file;
+        }
+        file_count++;
+    }
+    
+    // 按当前物理位置排序, 保持文件之间原有的先后顺序
+    movable_file_t* order[BLOCK_SIZE / sizeof(dir_entry_t)];
+    for (int i = 0; i < file_count; i++) {
+        int j = i;
+        while (j > 0 && order[j - 1]->first > files[i].first) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = &files[i];
+    }
+    
+    int largest_before;
+    int extents_before = count_free_extents(&largest_before);
+    int relocated = 0;
+    int next = cursor;
+    int done = 0;
+    
+    for (done = 0; done < file_count; done++) {
+        if (budget_ms > 0 && trace_now_ns() >= deadline) {
+            break;
+        }
+        
+        // 从next开始找一段能放下文件、且不含固定块的区域
+        movable_file_t* file = order[done];
+        int start = next;
+        int end = start;
+        while (end < start + file->blocks && end < DATA_BLOCKS) {
+            if (block_used(end) && !owners[end]) {
+                start = end + 1;
+            }
+            end++;
+        }
+        if (start + file->blocks > DATA_BLOCKS) {
+            printf("  跳过 '%s': 固定块之间没有足够的空间\n", file->name);
+            continue;
+        }
+        
+        int old_first = file->first;
+        int extents = count_extents(&file->inode, NULL);
+        int moved = compact_file(file, start, owners);
+        if (moved < 0) {
+            printf("没有空闲块可用于腾挪, 停止整理\n");
+            break;
+        }
+        if (moved) {
+            printf("  移动 '%s': %d 个区段 -> 1, 起始块 %d -> %d\n", file->name, extents,
+                   DATA_START_BLOCK + old_first, DATA_START_BLOCK + start);
+            relocated++;
+        }
+        next = start + file->blocks;
+    }
+    
+    // 全部文件处理完后下次从头开始, 否则从已整理部分之后继续
+    fs.superblock.defrag_cursor = (done < file_count) ? next : 0;
+    disk_write_block(SUPERBLOCK_BLOCK, &fs.superblock);
+    
+    int largest_after;
+    int extents_after = count_free_extents(&largest_after);
+    printf("空闲区段数: %d -> %d, 最大连续空闲块数: %d -> %d\n",
+           extents_before, extents_after, largest_before, largest_after);
+    if (done < file_count) {
+        printf("本次整理了 %d 个文件, 未完成, 下次从数据块 %d 继续\n", relocated, DATA_START_BLOCK + next);
+    } else {
+        printf("本次整理了 %d 个文件, 已完成一轮整理\n", relocated);
+    }
+    return relocated;
+}
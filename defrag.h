@@ -0,0 +1,14 @@
+#ifndef DEFRAG_H
+#define DEFRAG_H
+
+#include "file_ops.h"
+
+// 显示每个文件和整个镜像的碎片情况
+int show_fragmentation();
+
+// 整理碎片, 按物理位置依次把文件滑到最低的空闲位置, 使文件连续且空闲空间集中
+// budget_ms为本次最多运行的毫秒数 (0表示不限时), 超时后下次从中断处继续
+// 返回本次重新布局的文件数
+int defrag_disk(int budget_ms);
+
+#endif
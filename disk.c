@@ -1,7 +1,304 @@
+#define _POSIX_C_SOURCE 200809L
 #include "disk.h"
+#include <pthread.h>
 
 filesystem_t fs = {0};
 
+// 条带成员: 每个成员文件由一个工作线程负责多块请求
+typedef struct {
+    FILE* file;                        // 成员文件句柄
+    pthread_t thread;                  // 工作线程
+    uint32_t index;                    // 成员序号
+    int shutdown;                      // 是否通知工作线程退出
+    int has_job;                       // 是否有待处理的请求
+    int write;                         // 1: 写, 0: 读
+    const uint32_t* block_nums;        // 请求的逻辑块号列表, NULL表示从block_num开始连续
+    uint32_t block_num;                // 请求的逻辑起始块
+    uint32_t count;                    // 请求的块数
+    char* buffer;                      // 请求的数据缓冲区
+} stripe_member_t;
+
+// 两组成员交替使用: 重新配置时先在另一组上启动新成员, 全部就绪后再停止当前组
+static stripe_member_t member_sets[2][MAX_STRIPES];
+static stripe_member_t* members = member_sets[0];
+static uint32_t member_count = 1;      // 当前成员数, 1表示不条带化
+static uint32_t stripe_unit = 1;       // 当前条带单元 (块数)
+static char primary_path[STRIPE_PATH_LEN];
+static char primary_dir[MEMBER_PATH_MAX];  // 主镜像所在目录, 相对的成员路径以此为基准
+
+static pthread_mutex_t stripe_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stripe_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t stripe_done = PTHREAD_COND_INITIALIZER;
+static int stripe_pending = 0;         // 尚未完成的成员请求数
+
+/**
+ * 把逻辑块号映射到成员文件及其中的块号
+ */
+static uint32_t map_block(uint32_t block_num, uint32_t* member_block) {
+    uint32_t unit_index = block_num / stripe_unit;
+    *member_block = (unit_index / member_count) * stripe_unit + block_num % stripe_unit;
+    return unit_index % member_count;
+}
+
+/**
+ * 在成员文件中读写一块
+ */
+static void member_io(uint32_t block_num, char* buffer, int write) {
+    uint32_t member_block;
+    FILE* file = members[map_block(block_num, &member_block)].file;
+    
+    fseek(file, (long)member_block * BLOCK_SIZE, SEEK_SET);
+    if (write) {
+        fwrite(buffer, BLOCK_SIZE, 1, file);
+    } else {
+        fread(buffer, BLOCK_SIZE, 1, file);
+    }
+}
+
+/**
+ * 处理请求中落在成员index上的所有块
+ * 成员文件中相邻、缓冲区中也相邻的块合并成一次定位、一次读写,
+ * 连续请求在同一成员上相邻的条带单元在成员文件中也相邻, 因此最多每个条带单元定位一次
+ */
+static void member_batch_io(uint32_t index, const uint32_t* block_nums, uint32_t block_num,
+                            uint32_t count, char* buffer, int write) {
+    FILE* file = members[index].file;
+    uint32_t run_start = 0;            // 当前合并段在请求中的起始下标
+    uint32_t run_block = 0;            // 当前合并段在成员文件中的起始块
+    uint32_t run_len = 0;
+    
+    for (uint32_t i = 0; i <= count; i++) {
+        uint32_t member_block = 0;
+        int owned = 0;
+        if (i < count) {
+            uint32_t b = block_nums ? block_nums[i] : block_num + i;
+            owned = (map_block(b, &member_block) == index);
+        }
+        
+        // 能接在当前段之后就继续合并
+        if (owned && run_len > 0 && i == run_start + run_len && member_block == run_block + run_len) {
+            run_len++;
+            continue;
+        }
+        
+        if (run_len > 0) {
+            fseek(file, (long)run_block * BLOCK_SIZE, SEEK_SET);
+            if (write) {
+                fwrite(buffer + (size_t)run_start * BLOCK_SIZE, BLOCK_SIZE, run_len, file);
+            } else {
+                fread(buffer + (size_t)run_start * BLOCK_SIZE, BLOCK_SIZE, run_len, file);
+            }
+            run_len = 0;
+        }
+        if (owned) {
+            run_start = i;
+            run_block = member_block;
+            run_len = 1;
+        }
+    }
+    if (write) {
+        fflush(file);
+    }
+}
+
+/**
+ * 条带工作线程: 处理分派给本成员的请求
+ */
+static void* stripe_worker(void* arg) {
+    stripe_member_t* member = arg;
+    
+    while (1) {
+        pthread_mutex_lock(&stripe_lock);
+        while (!member->has_job && !member->shutdown) {
+            pthread_cond_wait(&stripe_work, &stripe_lock);
+        }
+        if (!member->has_job) {
+            pthread_mutex_unlock(&stripe_lock);
+            break;
+        }
+        pthread_mutex_unlock(&stripe_lock);
+        
+        member_batch_io(member->index, member->block_nums, member->block_num, member->count,
+                        member->buffer, member->write);
+        
+        pthread_mutex_lock(&stripe_lock);
+        member->has_job = 0;
+        if (--stripe_pending == 0) {
+            pthread_cond_signal(&stripe_done);
+        }
+        pthread_mutex_unlock(&stripe_lock);
+    }
+    return NULL;
+}
+
+/**
+ * 执行多块请求: 单个镜像时在当前线程完成,
+ * 条带化时分发给涉及的成员线程并行完成, 等待全部结束后返回
+ */
+static void batch_io(const uint32_t* block_nums, uint32_t block_num, uint32_t count, char* buffer, int write) {
+    if (member_count == 1) {
+        member_batch_io(0, block_nums, block_num, count, buffer, write);
+        return;
+    }
+    
+    // 找出请求涉及的成员
+    int involved[MAX_STRIPES] = {0};
+    uint32_t member_block;
+    for (uint32_t i = 0; i < count; i++) {
+        involved[map_block(block_nums ? block_nums[i] : block_num + i, &member_block)] = 1;
+    }
+    
+    pthread_mutex_lock(&stripe_lock);
+    for (uint32_t m = 0; m < member_count; m++) {
+        if (!involved[m]) {
+            continue;
+        }
+        
+        members[m].write = write;
+        members[m].block_nums = block_nums;
+        members[m].block_num = block_num;
+        members[m].count = count;
+        members[m].buffer = buffer;
+        members[m].has_job = 1;
+        stripe_pending++;
+    }
+    pthread_cond_broadcast(&stripe_work);
+    while (stripe_pending > 0) {
+        pthread_cond_wait(&stripe_done, &stripe_lock);
+    }
+    pthread_mutex_unlock(&stripe_lock);
+}
+
+/**
+ * 把成员路径转换为可打开的路径: 相对路径以主镜像所在目录为基准
+ */
+static void resolve_member_path(const char* path, char* resolved, size_t size) {
+    if (path[0] == '/' || primary_dir[0] == '\0') {
+        snprintf(resolved, size, "%s", path);
+    } else {
+        snprintf(resolved, size, "%s/%s", primary_dir, path);
+    }
+}
+
+/**
+ * 打开成员文件, 文件须至少有blocks块
+ * create为1时 (格式化) 不存在则创建并扩展; 为0时 (挂载) 文件缺失或过短都视为失败
+ */
+static FILE* open_member(const char* path, uint32_t blocks, int create) {
+    char resolved[MEMBER_PATH_MAX];
+    resolve_member_path(path, resolved, sizeof(resolved));
+    
+    FILE* file = fopen(resolved, "rb+");
+    if (!file) {
+        if (!create) {
+            printf("错误: 条带成员 '%s' 不存在\n", resolved);
+            return NULL;
+        }
+        file = fopen(resolved, "wb+");
+        if (!file) {
+            printf("错误: 无法创建条带成员 '%s'\n", resolved);
+            return NULL;
+        }
+    }
+    
+    fseek(file, 0, SEEK_END);
+    if (ftell(file) < (long)blocks * BLOCK_SIZE) {
+        if (!create) {
+            printf("错误: 条带成员 '%s' 小于 %u 块\n", resolved, blocks);
+            fclose(file);
+            return NULL;
+        }
+        fseek(file, (long)blocks * BLOCK_SIZE - 1, SEEK_SET);
+        fputc(0, file);
+    }
+    fseek(file, 0, SEEK_SET);
+    return file;
+}
+
+/**
+ * 通知一组成员的前count个工作线程退出并等待其结束
+ */
+static void stop_workers(stripe_member_t* set, uint32_t count) {
+    pthread_mutex_lock(&stripe_lock);
+    for (uint32_t m = 0; m < count; m++) {
+        set[m].shutdown = 1;
+    }
+    pthread_cond_broadcast(&stripe_work);
+    pthread_mutex_unlock(&stripe_lock);
+    
+    for (uint32_t m = 0; m < count; m++) {
+        pthread_join(set[m].thread, NULL);
+    }
+}
+
+/**
+ * 停止工作线程并关闭除主镜像以外的成员文件
+ */
+static void close_stripes() {
+    if (member_count > 1) {
+        stop_workers(members, member_count);
+        for (uint32_t m = 1; m < member_count; m++) {
+            fclose(members[m].file);
+        }
+    }
+    
+    memset(members, 0, sizeof(member_sets[0]));
+    members[0].file = fs.file;
+    member_count = 1;
+    stripe_unit = 1;
+}
+
+/**
+ * 放弃尚未启用的一组成员: 停止已启动的started个线程, 关闭已打开的opened个成员文件
+ */
+static void discard_stripes(stripe_member_t* set, uint32_t opened, uint32_t started) {
+    stop_workers(set, started);
+    for (uint32_t m = 1; m < opened; m++) {
+        fclose(set[m].file);
+    }
+    memset(set, 0, sizeof(member_sets[0]));
+}
+
+/**
+ * 按条带配置打开成员文件并启动工作线程, create为1时创建缺失的成员文件
+ * 新成员的文件和线程全部就绪后才替换当前成员; 失败时当前配置保持不变
+ */
+static int open_stripes(uint32_t count, uint32_t unit, char paths[][STRIPE_PATH_LEN], int create) {
+    if (count <= 1) {
+        close_stripes();
+        return 0;
+    }
+    
+    stripe_member_t* next = (members == member_sets[0]) ? member_sets[1] : member_sets[0];
+    memset(next, 0, sizeof(member_sets[0]));
+    next[0].file = fs.file;
+    
+    // 每个成员需要容纳的块数
+    uint32_t rows = (DISK_BLOCKS + unit * count - 1) / (unit * count);
+    for (uint32_t m = 1; m < count; m++) {
+        next[m].file = open_member(paths[m], rows * unit, create);
+        if (!next[m].file) {
+            discard_stripes(next, m, 0);
+            return -1;
+        }
+    }
+    
+    for (uint32_t m = 0; m < count; m++) {
+        next[m].index = m;
+        if (pthread_create(&next[m].thread, NULL, stripe_worker, &next[m]) != 0) {
+            printf("错误: 无法启动条带成员 %u 的工作线程\n", m);
+            discard_stripes(next, count, m);
+            return -1;
+        }
+    }
+    
+    close_stripes();
+    members = next;
+    member_count = count;
+    stripe_unit = unit;
+    return 0;
+}
+
 /**
  * 初始化磁盘系统
  */
@@ -19,32 +316,92 @@ int disk_init(const char* filename) {
         fputc(0, fs.file);
         fseek(fs.file, 0, SEEK_SET);
     }
+    members[0].file = fs.file;
+    snprintf(primary_path, sizeof(primary_path), "%s", filename);
+    const char* slash = strrchr(filename, '/');
+    if (slash == filename) {
+        strcpy(primary_dir, "/");
+    } else {
+        snprintf(primary_dir, sizeof(primary_dir), "%.*s", slash ? (int)(slash - filename) : 0, filename);
+    }
     
-    // 读取超级块
+    // 读取超级块 (超级块总是位于成员0的第0块)
     disk_read_block(SUPERBLOCK_BLOCK, &fs.superblock);
     
     // 如果是第一次初始化或者魔数不正确，则需要格式化
-    if (fs.superblock.magic != 0x12345678) {
+    if (fs.superblock.magic != FS_MAGIC) {
         printf("检测到未初始化的磁盘，请执行 format 命令来手动初始化...\n");
+        fs.superblock.stripe_count = 1;
+        fs.superblock.stripe_unit = 1;
+        memset(fs.superblock.stripe_paths, 0, sizeof(fs.superblock.stripe_paths));
     } else {
+        // 条带字段为0的旧镜像按单个镜像文件处理
+        if (fs.superblock.stripe_count <= 1 || fs.superblock.stripe_unit == 0) {
+            fs.superblock.stripe_count = 1;
+            fs.superblock.stripe_unit = 1;
+        }
+        
+        // 打开条带成员文件
+        if (fs.superblock.stripe_count > MAX_STRIPES ||
+            open_stripes(fs.superblock.stripe_count, fs.superblock.stripe_unit, fs.superblock.stripe_paths, 0) < 0) {
+            fclose(fs.file);
+            fs.file = NULL;
+            return -1;
+        }
+        
         // 读取inode位图
         disk_read_block(INODE_BITMAP_BLOCK, fs.inode_bitmap);
         
         // 读取数据块位图
         disk_read_block(DATA_BITMAP_BLOCK, fs.data_bitmap);
+        
+        // 读取数据块引用计数表
+        disk_read_blocks(REFCOUNT_START_BLOCK, REFCOUNT_BLOCKS, fs.block_refs);
     }
     
     return 0;
 }
 
+/**
+ * 设置条带配置: count个成员, 每个条带单元unit块
+ * paths为成员1到count-1的文件路径, 成员0为主镜像; 配置在下次写超级块时落盘
+ */
+int disk_set_stripes(uint32_t count, uint32_t unit, const char* paths[]) {
+    if (count < 1 || count > MAX_STRIPES || unit < 1 || unit > DISK_BLOCKS) {
+        printf("错误: 条带成员数须为1~%d, 条带单元须为1~%d块\n", MAX_STRIPES, DISK_BLOCKS);
+        return -1;
+    }
+    
+    char new_paths[MAX_STRIPES][STRIPE_PATH_LEN] = {{0}};
+    snprintf(new_paths[0], STRIPE_PATH_LEN, "%s", primary_path);
+    for (uint32_t m = 1; m < count; m++) {
+        if (strlen(paths[m - 1]) >= STRIPE_PATH_LEN) {
+            printf("错误: 条带成员路径 '%s' 过长\n", paths[m - 1]);
+            return -1;
+        }
+        strcpy(new_paths[m], paths[m - 1]);
+    }
+    
+    // 打开失败时仍使用原有配置, 超级块也不做修改
+    if (open_stripes(count, unit, new_paths, 1) < 0) {
+        return -1;
+    }
+    memcpy(fs.superblock.stripe_paths, new_paths, sizeof(new_paths));
+    fs.superblock.stripe_count = count;
+    fs.superblock.stripe_unit = unit;
+    return 0;
+}
+
 /**
  * 关闭磁盘系统
  */
 void disk_close() {
+    close_stripes();
     if (fs.file) {
         fclose(fs.file);
         fs.file = NULL;
     }
+    members[0].file = NULL;
 }
 
 /**
@@ -55,8 +412,7 @@ int disk_read_block(uint32_t block_num, void* buffer) {
         return -1;
     }
     
-    fseek(fs.file, block_num * BLOCK_SIZE, SEEK_SET);
-    fread(buffer, BLOCK_SIZE, 1, fs.file);
+    member_io(block_num, buffer, 0);
     return 0;
 }
 
@@ -68,8 +424,71 @@ int disk_write_block(uint32_t block_num, const void* buffer) {
         return -1;
     }
     
-    fseek(fs.file, block_num * BLOCK_SIZE, SEEK_SET);
-    fwrite(buffer, BLOCK_SIZE, 1, fs.file);
-    fflush(fs.file);
+    uint32_t member_block;
+    FILE* file = members[map_block(block_num, &member_block)].file;
+    member_io(block_num, (char*)buffer, 1);
+    fflush(file);
+    return 0;
+}
+
+/**
+ * 读取连续的多个块
+ * 单个镜像时一次定位、一次读取; 条带化时各成员线程并行读取
+ */
+int disk_read_blocks(uint32_t block_num, uint32_t count, void* buffer) {
+    if (block_num >= DISK_BLOCKS || count > DISK_BLOCKS - block_num || !buffer) {
+        return -1;
+    }
+    
+    batch_io(NULL, block_num, count, buffer, 0);
+    return 0;
+}
+
+/**
+ * 写入连续的多个块
+ * 单个镜像时一次定位、一次写入; 条带化时各成员线程并行写入
+ */
+int disk_write_blocks(uint32_t block_num, uint32_t count, const void* buffer) {
+    if (block_num >= DISK_BLOCKS || count > DISK_BLOCKS - block_num || !buffer) {
+        return -1;
+    }
+    
+    batch_io(NULL, block_num, count, (char*)buffer, 1);
+    return 0;
+}
+
+/**
+ * 读取任意一组块到连续的缓冲区 (第i块对应缓冲区第i个块大小的区域)
+ * 相邻的块合并读取; 条带化时各成员线程并行读取
+ */
+int disk_read_block_list(const uint32_t* block_nums, uint32_t count, void* buffer) {
+    if (!block_nums || !buffer) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (block_nums[i] >= DISK_BLOCKS) {
+            return -1;
+        }
+    }
+    
+    batch_io(block_nums, 0, count, buffer, 0);
+    return 0;
+}
+
+/**
+ * 把连续缓冲区写入任意一组块
+ * 相邻的块合并写入; 条带化时各成员线程并行写入
+ */
+int disk_write_block_list(const uint32_t* block_nums, uint32_t count, const void* buffer) {
+    if (!block_nums || !buffer) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (block_nums[i] >= DISK_BLOCKS) {
+            return -1;
+        }
+    }
+    
+    batch_io(block_nums, 0, count, (char*)buffer, 1);
     return 0;
-}
\ No newline at end of file
+}
@@ -15,9 +15,17 @@
 #define DATA_BITMAP_BLOCK 2            // 数据块位图起始块
 #define INODE_START_BLOCK 3            // inode表起始块
 #define INODE_BLOCKS 128               // inode表占用块数
-#define DATA_START_BLOCK (INODE_START_BLOCK + INODE_BLOCKS)  // 数据区起始块
+#define REFCOUNT_START_BLOCK (INODE_START_BLOCK + INODE_BLOCKS)  // 数据块引用计数表起始块
+#define REFCOUNT_BLOCKS 8              // 引用计数表占用块数 (每个数据块1字节)
+#define DATA_START_BLOCK (REFCOUNT_START_BLOCK + REFCOUNT_BLOCKS)  // 数据区起始块
 #define DATA_BLOCKS (DISK_BLOCKS - DATA_START_BLOCK)         // 数据块数量
 
+#define FS_MAGIC 0x12345679            // 文件系统魔数 (磁盘布局变化时递增)
+
+#define MAX_STRIPES 8                  // 条带成员文件数上限
+#define STRIPE_PATH_LEN 56             // 条带成员文件路径长度上限
+#define MEMBER_PATH_MAX 512            // 相对主镜像目录解析后的成员路径长度上限
+
 // inode结构
 typedef struct {
     uint32_t size;                     // 文件大小
@@ -34,23 +42,33 @@ typedef struct {
     uint32_t data_blocks;              // 数据区可用块数
     uint32_t free_inode_count;         // 空闲inode数
     uint32_t free_data_count;          // 空闲数据块数
-    char padding[BLOCK_SIZE - 6*sizeof(uint32_t) - sizeof(uint16_t)];
+    uint32_t stripe_count;             // 条带成员文件数 (0或1表示单个镜像文件)
+    uint32_t stripe_unit;              // 条带单元 (块数)
+    char stripe_paths[MAX_STRIPES][STRIPE_PATH_LEN];  // 条带成员文件路径 (成员0为主镜像)
+    uint32_t defrag_cursor;            // 碎片整理下次开始的数据块下标, 使增量整理跨进程继续
+    char padding[BLOCK_SIZE - 9*sizeof(uint32_t) - MAX_STRIPES*STRIPE_PATH_LEN - sizeof(uint16_t)];
     uint16_t state;                    // 文件系统状态
 } superblock_t;
 
 // 文件系统结构
 typedef struct {
-    FILE* file;                        // 磁盘映像文件句柄
+    FILE* file;                        // 磁盘映像文件句柄 (条带化时为成员0)
     superblock_t superblock;          // 超级块缓存
     char inode_bitmap[INODE_BLOCKS * BLOCK_SIZE];  // inode位图缓存
-    char data_bitmap[DATA_BLOCKS / 8]; // 数据块位图缓存 (每个bit代表一个数据块)
+    char data_bitmap[BLOCK_SIZE];      // 数据块位图缓存 (每个bit代表一个数据块, 按整块读写)
+    uint8_t block_refs[REFCOUNT_BLOCKS * BLOCK_SIZE];  // 数据块引用计数缓存 (0: 空闲, >1: 被克隆文件共享)
 } filesystem_t;
 
 extern filesystem_t fs;
 
 int disk_init(const char* filename);
 void disk_close();
+int disk_set_stripes(uint32_t count, uint32_t unit, const char* paths[]);
 int disk_read_block(uint32_t block_num, void* buffer);
 int disk_write_block(uint32_t block_num, const void* buffer);
+int disk_read_blocks(uint32_t block_num, uint32_t count, void* buffer);
+int disk_write_blocks(uint32_t block_num, uint32_t count, const void* buffer);
+int disk_read_block_list(const uint32_t* block_nums, uint32_t count, void* buffer);
+int disk_write_block_list(const uint32_t* block_nums, uint32_t count, const void* buffer);
 
 #endif
\ No newline at end of file
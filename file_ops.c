@@ -1,16 +1,57 @@
 #include "file_ops.h"
+#include "trace.h"
 #include <time.h>
 
 // 计算每个块可以容纳多少个inode
 #define INODES_PER_BLOCK (BLOCK_SIZE / sizeof(inode_t))
 
+/**
+ * 读取指定inode (经由整块缓冲区, 避免按块读写越界)
+ */
+void read_inode(int inode_num, inode_t* inode) {
+    char inode_block[BLOCK_SIZE];
+    disk_read_block(INODE_START_BLOCK + inode_num / INODES_PER_BLOCK, inode_block);
+    *inode = ((inode_t*)inode_block)[inode_num % INODES_PER_BLOCK];
+}
+
+/**
+ * 写回指定inode
+ */
+void write_inode(int inode_num, const inode_t* inode) {
+    char inode_block[BLOCK_SIZE];
+    disk_read_block(INODE_START_BLOCK + inode_num / INODES_PER_BLOCK, inode_block);
+    ((inode_t*)inode_block)[inode_num % INODES_PER_BLOCK] = *inode;
+    disk_write_block(INODE_START_BLOCK + inode_num / INODES_PER_BLOCK, inode_block);
+}
+
+/**
+ * 将数据块对应的引用计数所在块写回磁盘
+ */
+static void write_block_ref(int block_num) {
+    int ref_block_index = (block_num - DATA_START_BLOCK) / BLOCK_SIZE;
+    disk_write_block(REFCOUNT_START_BLOCK + ref_block_index, fs.block_refs + ref_block_index * BLOCK_SIZE);
+}
+
+/**
+ * 查询数据块的引用计数
+ */
+static int block_refcount(int block_num) {
+    return fs.block_refs[block_num - DATA_START_BLOCK];
+}
+
 /**
  * 格式化磁盘
  */
 int format_disk() {
-    // 初始化超级块
+    trace_log(TRACE_FORMAT, NULL, NULL, 0, 0);
+    
+    // 初始化超级块, 保留由 disk_set_stripes 设置的条带配置
+    superblock_t old_superblock = fs.superblock;
     memset(&fs.superblock, 0, sizeof(superblock_t));
-    fs.superblock.magic = 0x12345678;
+    fs.superblock.stripe_count = old_superblock.stripe_count ? old_superblock.stripe_count : 1;
+    fs.superblock.stripe_unit = old_superblock.stripe_unit ? old_superblock.stripe_unit : 1;
+    memcpy(fs.superblock.stripe_paths, old_superblock.stripe_paths, sizeof(fs.superblock.stripe_paths));
+    fs.superblock.magic = FS_MAGIC;
     fs.superblock.blocks = DISK_BLOCKS;
     fs.superblock.inode_blocks = INODE_BLOCKS;
     fs.superblock.data_blocks = DATA_BLOCKS;
@@ -35,6 +76,15 @@ int format_disk() {
     // 写入数据块位图
     disk_write_block(DATA_BITMAP_BLOCK, fs.data_bitmap);
     
+    // 初始化数据块引用计数表
+    memset(fs.block_refs, 0, sizeof(fs.block_refs));
+    fs.block_refs[0] = 1; // 根目录数据块
+    
+    // 写入引用计数表
+    for (int i = 0; i < REFCOUNT_BLOCKS; i++) {
+        disk_write_block(REFCOUNT_START_BLOCK + i, fs.block_refs + i * BLOCK_SIZE);
+    }
+    
     // 初始化根目录inode
     inode_t root_inode = {0};
     root_inode.type = 2; // 目录
@@ -58,12 +108,26 @@ int format_disk() {
  * 显示磁盘信息
  */
 int show_disk_info() {
+    int shared_count = 0;
+    for (int i = 0; i < DATA_BLOCKS; i++) {
+        if (fs.block_refs[i] > 1) {
+            shared_count++;
+        }
+    }
+    
     printf("\n磁盘信息:\n");
     printf("  总块数: %u\n", fs.superblock.blocks);
     printf("  Inode区块数: %u\n", fs.superblock.inode_blocks);
     printf("  数据区块数: %u\n", fs.superblock.data_blocks);
     printf("  空闲Inode数: %u\n", fs.superblock.free_inode_count);
     printf("  空闲数据块数: %u\n", fs.superblock.free_data_count);
+    printf("  共享数据块数: %d\n", shared_count);
+    if (fs.superblock.stripe_count > 1) {
+        printf("  条带: %u 个成员, 条带单元 %u 块\n", fs.superblock.stripe_count, fs.superblock.stripe_unit);
+        for (uint32_t i = 0; i < fs.superblock.stripe_count; i++) {
+            printf("    成员%u: %s\n", i, fs.superblock.stripe_paths[i]);
+        }
+    }
     printf("  文件系统状态: %s\n", fs.superblock.state ? "已挂载" : "未挂载");
     printf("\n");
     return 0;
@@ -120,10 +184,12 @@ int alloc_block() {
     for (int i = 0; i < DATA_BLOCKS; i++) {
         if (!(fs.data_bitmap[i / 8] & (1 << (i % 8)))) {
             fs.data_bitmap[i / 8] |= (1 << (i % 8));
+            fs.block_refs[i] = 1;
             fs.superblock.free_data_count--;
             
-            // 更新磁盘上的位图和超级块
+            // 更新磁盘上的位图、引用计数和超级块
             disk_write_block(DATA_BITMAP_BLOCK, fs.data_bitmap);
+            write_block_ref(DATA_START_BLOCK + i);
             disk_write_block(SUPERBLOCK_BLOCK, &fs.superblock);
             
             return DATA_START_BLOCK + i;
@@ -133,8 +199,96 @@ int alloc_block() {
     return -1; // 没有找到空闲数据块
 }
 
+/**
+ * 分配指定的数据块, 块已被占用时失败
+ */
+int alloc_block_at(int block_num) {
+    if (block_num < DATA_START_BLOCK || block_num >= DISK_BLOCKS) {
+        return -1;
+    }
+    
+    int i = block_num - DATA_START_BLOCK;
+    if (fs.data_bitmap[i / 8] & (1 << (i % 8))) {
+        return -1; // 块已被占用
+    }
+    
+    fs.data_bitmap[i / 8] |= (1 << (i % 8));
+    fs.block_refs[i] = 1;
+    fs.superblock.free_data_count--;
+    
+    // 更新磁盘上的位图、引用计数和超级块
+    disk_write_block(DATA_BITMAP_BLOCK, fs.data_bitmap);
+    write_block_ref(block_num);
+    disk_write_block(SUPERBLOCK_BLOCK, &fs.superblock);
+    
+    return block_num;
+}
+
+/**
+ * 在数据块位图中查找第一段长度为count的连续空闲区, 返回起始下标
+ */
+static int find_free_run(int count) {
+    int run_start = -1;
+    int run_len = 0;
+    for (int i = 0; i < DATA_BLOCKS; i++) {
+        if (!(fs.data_bitmap[i / 8] & (1 << (i % 8)))) {
+            if (run_len == 0) {
+                run_start = i;
+            }
+            if (++run_len == count) {
+                return run_start;
+            }
+        } else {
+            run_len = 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * 批量分配数据块
+ * 优先取第一段足够长的连续空闲区, 找不到时退回逐块首次适配;
+ * 位图、引用计数和超级块在整批分配后只写回一次
+ */
+int alloc_blocks(int count, int* blocks) {
+    if (count <= 0) {
+        return 0;
+    }
+    if (fs.superblock.free_data_count < (uint32_t)count) {
+        return -1; // 空闲数据块不足
+    }
+    
+    int run_start = find_free_run(count);
+    
+    int allocated = 0;
+    int first = -1;
+    int last = -1;
+    for (int i = (run_start >= 0) ? run_start : 0; i < DATA_BLOCKS && allocated < count; i++) {
+        if (!(fs.data_bitmap[i / 8] & (1 << (i % 8)))) {
+            fs.data_bitmap[i / 8] |= (1 << (i % 8));
+            fs.block_refs[i] = 1;
+            blocks[allocated++] = DATA_START_BLOCK + i;
+            if (first < 0) {
+                first = i;
+            }
+            last = i;
+        }
+    }
+    fs.superblock.free_data_count -= allocated;
+    
+    // 更新磁盘上的位图、引用计数和超级块
+    disk_write_block(DATA_BITMAP_BLOCK, fs.data_bitmap);
+    for (int i = first / BLOCK_SIZE; i <= last / BLOCK_SIZE; i++) {
+        disk_write_block(REFCOUNT_START_BLOCK + i, fs.block_refs + i * BLOCK_SIZE);
+    }
+    disk_write_block(SUPERBLOCK_BLOCK, &fs.superblock);
+    
+    return allocated;
+}
+
 /**
  * 释放一个数据块
+ * 块被多个文件共享时只减少引用计数, 最后一个引用释放时才归还位图
  */
 void free_block(int block_num) {
     if (block_num < DATA_START_BLOCK || block_num >= DISK_BLOCKS) {
@@ -142,11 +296,19 @@ void free_block(int block_num) {
     }
     
     int data_block_index = block_num - DATA_START_BLOCK;
+    if (fs.block_refs[data_block_index] > 1) {
+        fs.block_refs[data_block_index]--;
+        write_block_ref(block_num);
+        return;
+    }
+    
     fs.data_bitmap[data_block_index / 8] &= ~(1 << (data_block_index % 8));
+    fs.block_refs[data_block_index] = 0;
     fs.superblock.free_data_count++;
     
-    // 更新磁盘上的位图和超级块
+    // 更新磁盘上的位图、引用计数和超级块
     disk_write_block(DATA_BITMAP_BLOCK, fs.data_bitmap);
+    write_block_ref(block_num);
     disk_write_block(SUPERBLOCK_BLOCK, &fs.superblock);
 }
 
@@ -154,9 +316,11 @@ void free_block(int block_num) {
  * 创建文件
  */
 int create_file(const char* filename) {
+    trace_log(TRACE_CREATE, filename, NULL, 0, 0);
+    
     // 查找根目录中是否已存在同名文件
     inode_t root_inode;
-    disk_read_block(INODE_START_BLOCK, &root_inode);
+    read_inode(0, &root_inode);
     
     char root_data[BLOCK_SIZE];
     disk_read_block(root_inode.blocks[0], root_data);
@@ -239,9 +403,11 @@ int create_file(const char* filename) {
  * 删除文件
  */
 int delete_file(const char* filename) {
+    trace_log(TRACE_DELETE, filename, NULL, 0, 0);
+    
     // 查找根目录中的文件
     inode_t root_inode;
-    disk_read_block(INODE_START_BLOCK, &root_inode);
+    read_inode(0, &root_inode);
     
     char root_data[BLOCK_SIZE];
     disk_read_block(root_inode.blocks[0], root_data);
@@ -295,8 +461,10 @@ int delete_file(const char* filename) {
  * 列出目录内容
  */
 int list_directory() {
+    trace_log(TRACE_LIST, NULL, NULL, 0, 0);
+    
     inode_t root_inode;
-    disk_read_block(INODE_START_BLOCK, &root_inode);
+    read_inode(0, &root_inode);
     
     char root_data[BLOCK_SIZE];
     disk_read_block(root_inode.blocks[0], root_data);
@@ -337,9 +505,11 @@ int list_directory() {
  * 读取文件内容
  */
 int read_file(const char* filename, char* buffer, size_t size) {
+    trace_log(TRACE_READ, filename, NULL, size, 0);
+    
     // 查找根目录中的文件
     inode_t root_inode;
-    disk_read_block(INODE_START_BLOCK, &root_inode);
+    read_inode(0, &root_inode);
     
     char root_data[BLOCK_SIZE];
     disk_read_block(root_inode.blocks[0], root_data);
@@ -379,15 +549,18 @@ int read_file(const char* filename, char* buffer, size_t size) {
     size_t bytes_to_read = (size < file_inode.size) ? size : file_inode.size;
     size_t bytes_read = 0;
     
-    for (int i = 0; i < 8 && bytes_read < bytes_to_read && file_inode.blocks[i] != 0; i++) {
-        char block_data[BLOCK_SIZE];
-        disk_read_block(file_inode.blocks[i], block_data);
-        
+    int block_count = 0;
+    while (block_count < 8 && bytes_read < bytes_to_read && file_inode.blocks[block_count] != 0) {
         size_t block_bytes = (bytes_to_read - bytes_read < BLOCK_SIZE) ? (bytes_to_read - bytes_read) : BLOCK_SIZE;
-        memcpy(buffer + bytes_read, block_data, block_bytes);
         bytes_read += block_bytes;
+        block_count++;
     }
     
+    // 一次读取所有需要的数据块 (条带化时各成员并行读取)
+    char file_data[8 * BLOCK_SIZE];
+    disk_read_block_list(file_inode.blocks, block_count, file_data);
+    memcpy(buffer, file_data, bytes_read);
+    
     return bytes_read;
 }
 
@@ -395,9 +568,11 @@ int read_file(const char* filename, char* buffer, size_t size) {
  * 写入文件内容
  */
 int write_file(const char* filename, const char* buffer, size_t size) {
+    trace_log(TRACE_WRITE, filename, NULL, size, 0);
+    
     // 查找根目录中的文件
     inode_t root_inode;
-    disk_read_block(INODE_START_BLOCK, &root_inode);
+    read_inode(0, &root_inode);
     
     char root_data[BLOCK_SIZE];
     disk_read_block(root_inode.blocks[0], root_data);
@@ -433,37 +608,43 @@ int write_file(const char* filename, const char* buffer, size_t size) {
         return -1;
     }
     
-    // 释放原有数据块
-    for (int i = 0; i < 8 && file_inode.blocks[i] != 0; i++) {
-        free_block(file_inode.blocks[i]);
-        file_inode.blocks[i] = 0;
-    }
-    
-    // 写入文件内容
+    // 写入文件内容: 独占的原有数据块原地覆盖, 与克隆文件共享的块写时复制
     size_t bytes_written = 0;
     int block_index = 0;
+    char file_data[8 * BLOCK_SIZE] = {0};
     
     while (bytes_written < size && block_index < 8) {
-        // 分配新的数据块
-        int new_block = alloc_block();
-        if (new_block < 0) {
-            printf("错误: 磁盘空间不足\n");
-            break;
+        int old_block = file_inode.blocks[block_index];
+        if (old_block == 0 || block_refcount(old_block) > 1) {
+            // 分配新的数据块, 再解除对共享块的引用
+            int new_block = alloc_block();
+            if (new_block < 0) {
+                printf("错误: 磁盘空间不足\n");
+                break;
+            }
+            if (old_block != 0) {
+                free_block(old_block);
+            }
+            file_inode.blocks[block_index] = new_block;
         }
-        file_inode.blocks[block_index] = new_block;
         
         // 准备要写入的数据块
-        char block_data[BLOCK_SIZE] = {0};
         size_t block_bytes = (size - bytes_written < BLOCK_SIZE) ? (size - bytes_written) : BLOCK_SIZE;
-        memcpy(block_data, buffer + bytes_written, block_bytes);
-        
-        // 写入数据块
-        disk_write_block(file_inode.blocks[block_index], block_data);
+        memcpy(file_data + block_index * BLOCK_SIZE, buffer + bytes_written, block_bytes);
         
         bytes_written += block_bytes;
         block_index++;
     }
     
+    // 一次写入所有数据块 (条带化时各成员并行写入)
+    disk_write_block_list(file_inode.blocks, block_index, file_data);
+    
+    // 释放新内容不再使用的原有数据块
+    for (int i = block_index; i < 8 && file_inode.blocks[i] != 0; i++) {
+        free_block(file_inode.blocks[i]);
+        file_inode.blocks[i] = 0;
+    }
+    
     // 更新文件大小
     file_inode.size = bytes_written;
     
@@ -473,4 +654,94 @@ int write_file(const char* filename, const char* buffer, size_t size) {
     
     printf("向文件 '%s' 写入了 %zu 字节\n", filename, bytes_written);
     return bytes_written;
-}
\ No newline at end of file
+}
+
+/**
+ * 克隆文件 (cp --reflink)
+ * 新文件与源文件共享数据块, 只写入一个inode; 任一方写入时才复制对应的块
+ */
+int clone_file(const char* src, const char* dst) {
+    trace_log(TRACE_CLONE, src, dst, 0, 0);
+    
+    // 查找根目录中的源文件和目标槽位
+    inode_t root_inode;
+    read_inode(0, &root_inode);
+    
+    char root_data[BLOCK_SIZE];
+    disk_read_block(root_inode.blocks[0], root_data);
+    
+    dir_entry_t* entries = (dir_entry_t*)root_data;
+    int entry_count = BLOCK_SIZE / sizeof(dir_entry_t);
+    int src_index = -1;
+    int free_slot = -1;
+    
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].inode != 0) {
+            if (strcmp(entries[i].name, dst) == 0) {
+                printf("错误: 文件 '%s' 已存在\n", dst);
+                return -1;
+            }
+            if (strcmp(entries[i].name, src) == 0) {
+                src_index = i;
+            }
+        } else if (free_slot == -1) {
+            free_slot = i;
+        }
+    }
+    
+    if (src_index == -1) {
+        printf("错误: 文件 '%s' 不存在\n", src);
+        return -1;
+    }
+    
+    if (free_slot == -1) {
+        printf("错误: 目录已满\n");
+        return -1;
+    }
+    
+    inode_t src_inode;
+    read_inode(entries[src_index].inode, &src_inode);
+    
+    if (src_inode.type != 1) {
+        printf("错误: '%s' 不是一个普通文件\n", src);
+        return -1;
+    }
+    
+    // 分配inode
+    int inode_num = alloc_inode();
+    if (inode_num < 0) {
+        printf("错误: 没有可用的inode\n");
+        return -1;
+    }
+    
+    // 增加共享数据块的引用计数, 每个引用计数块只写回一次
+    int shared = 0;
+    char dirty[REFCOUNT_BLOCKS] = {0};
+    for (int i = 0; i < 8 && src_inode.blocks[i] != 0; i++) {
+        int data_block_index = src_inode.blocks[i] - DATA_START_BLOCK;
+        fs.block_refs[data_block_index]++;
+        dirty[data_block_index / BLOCK_SIZE] = 1;
+        shared++;
+    }
+    for (int i = 0; i < REFCOUNT_BLOCKS; i++) {
+        if (dirty[i]) {
+            disk_write_block(REFCOUNT_START_BLOCK + i, fs.block_refs + i * BLOCK_SIZE);
+        }
+    }
+    
+    // 新inode直接复用源文件的块指针
+    inode_t new_inode = src_inode;
+    new_inode.links = 1;
+    write_inode(inode_num, &new_inode);
+    
+    // 更新目录项
+    entries[free_slot].inode = inode_num;
+    strncpy(entries[free_slot].name, dst, MAX_FILENAME - 1);
+    entries[free_slot].name[MAX_FILENAME - 1] = '\0';
+    
+    // 写回根目录数据块
+    disk_write_block(root_inode.blocks[0], root_data);
+    
+    printf("文件 '%s' 已克隆为 '%s' (共享 %d 个数据块)\n", src, dst, shared);
+    return 0;
+}
@@ -5,6 +5,7 @@
 
 #define MAX_FILENAME 32
 #define MAX_FILES 128
+#define MAX_FILE_SIZE (8 * BLOCK_SIZE)
 
 // 目录项结构
 typedef struct {
@@ -27,9 +28,21 @@ void free_inode(int inode_num);
 // 分配一个数据块
 int alloc_block();
 
+// 批量分配数据块, 尽量取连续的一段, 返回分配的块数
+int alloc_blocks(int count, int *blocks);
+
+// 分配指定的数据块, 块已被占用时返回-1
+int alloc_block_at(int block_num);
+
 // 释放指定的数据块
 void free_block(int block_num);
 
+// 读取指定inode
+void read_inode(int inode_num, inode_t *inode);
+
+// 写回指定inode
+void write_inode(int inode_num, const inode_t *inode);
+
 // 创建新文件
 int create_file(const char *filename);
 
@@ -45,4 +58,7 @@ int write_file(const char *filename, const char *buffer, size_t size);
 // 列出目录中的所有文件
 int list_directory();
 
+// 克隆文件: 新文件与源文件共享数据块, 写入时复制
+int clone_file(const char *src, const char *dst);
+
 #endif
\ No newline at end of file
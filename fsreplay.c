@@ -0,0 +1,264 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "disk.h"
+#include "file_ops.h"
+#include "trace.h"
+#include "defrag.h"
+
+/**
+ * 跟踪回放工具: 在镜像上重新执行跟踪日志中的操作, 统计吞吐量和延迟分布
+ */
+
+// 单个操作类型的延迟统计
+typedef struct {
+    uint64_t* latencies;               // 每次操作的延迟 (纳秒)
+    int count;
+    int capacity;
+    uint64_t bytes;                    // 读写的字节数
+    int failed;                        // 执行失败的次数 (文件不存在、已存在等)
+} op_stats_t;
+
+static op_stats_t stats[TRACE_OP_COUNT];
+
+static void print_usage(const char* prog) {
+    printf("用法: %s <跟踪日志> <镜像> [--fresh] [--timed]\n", prog);
+    printf("  --fresh  回放前先格式化镜像, 否则在镜像 (快照) 当前内容上回放\n");
+    printf("  --timed  按记录的时间间隔回放, 否则尽快回放\n");
+}
+
+/**
+ * 记录一次操作的延迟
+ */
+static void add_latency(uint8_t op, uint64_t latency, uint64_t bytes) {
+    op_stats_t* s = &stats[op];
+    if (s->count == s->capacity) {
+        int capacity = s->capacity ? s->capacity * 2 : 256;
+        uint64_t* latencies = realloc(s->latencies, capacity * sizeof(uint64_t));
+        if (!latencies) {
+            return;
+        }
+        s->latencies = latencies;
+        s->capacity = capacity;
+    }
+    s->latencies[s->count++] = latency;
+    s->bytes += bytes;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * 打印一组延迟的分布 (微秒)
+ */
+static void print_distribution(const char* label, uint64_t* latencies, int count, uint64_t bytes) {
+    if (count == 0) {
+        return;
+    }
+    
+    qsort(latencies, count, sizeof(uint64_t), compare_u64);
+    uint64_t total = 0;
+    for (int i = 0; i < count; i++) {
+        total += latencies[i];
+    }
+    
+    printf("  %-8s %8d %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %12llu\n", label, count,
+           latencies[0] / 1000.0,
+           (double)total / count / 1000.0,
+           latencies[count * 50 / 100] / 1000.0,
+           latencies[count * 90 / 100] / 1000.0,
+           latencies[count * 99 / 100] / 1000.0,
+           latencies[count - 1] / 1000.0,
+           (unsigned long long)bytes);
+}
+
+/**
+ * 执行一条记录, 返回操作的返回值, 读写的字节数通过bytes返回
+ */
+static int replay_record(const trace_record_t* record, uint64_t* bytes) {
+    static char buffer[MAX_FILE_SIZE];
+    uint32_t size = record->size < MAX_FILE_SIZE ? record->size : MAX_FILE_SIZE;
+    int ret = 0;
+    
+    switch (record->op) {
+    case TRACE_FORMAT:
+        ret = format_disk();
+        break;
+    case TRACE_CREATE:
+        ret = create_file(record->name);
+        break;
+    case TRACE_DELETE:
+        ret = delete_file(record->name);
+        break;
+    case TRACE_READ:
+        ret = read_file(record->name, buffer, size);
+        break;
+    case TRACE_WRITE:
+        // 跟踪不记录文件内容, 用可复现的数据代替
+        for (uint32_t i = 0; i < size; i++) {
+            buffer[i] = 'a' + (i + record->name[0]) % 26;
+        }
+        ret = write_file(record->name, buffer, size);
+        break;
+    case TRACE_CLONE:
+        ret = clone_file(record->name, record->name2);
+        break;
+    case TRACE_LIST:
+        ret = list_directory();
+        break;
+    case TRACE_DEFRAG:
+        ret = defrag_disk(record->size);
+        break;
+    }
+    
+    int transfers = (record->op == TRACE_READ || record->op == TRACE_WRITE);
+    *bytes = (transfers && ret > 0) ? (uint64_t)ret : 0;
+    return ret;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    int fresh = 0;
+    int timed = 0;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--fresh") == 0) {
+            fresh = 1;
+        } else if (strcmp(argv[i], "--timed") == 0) {
+            timed = 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    FILE* trace = trace_open(argv[1]);
+    if (!trace) {
+        return 1;
+    }
+    
+    if (disk_init(argv[2]) < 0) {
+        printf("错误: 无法打开镜像 '%s'\n", argv[2]);
+        fclose(trace);
+        return 1;
+    }
+    
+    // 回放期间丢弃文件操作层的提示输出, 结束后恢复
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0) {
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+    
+    if (fresh) {
+        format_disk();
+    }
+    
+    trace_record_t record;
+    int result = 0;
+    int replayed = 0;
+    int formatted = (fs.superblock.magic == FS_MAGIC);
+    uint64_t start_ns = trace_now_ns();
+    
+    while ((result = trace_next(trace, &record)) == 1) {
+        if (!formatted && record.op != TRACE_FORMAT) {
+            result = -2;
+            break;
+        }
+        formatted = 1;
+        
+        // 按记录的时间间隔等待
+        if (timed) {
+            uint64_t target = start_ns + record.timestamp_ns;
+            uint64_t now = trace_now_ns();
+            if (target > now) {
+                struct timespec ts = {(time_t)((target - now) / 1000000000ULL), (long)((target - now) % 1000000000ULL)};
+                nanosleep(&ts, NULL);
+            }
+        }
+        
+        uint64_t begin = trace_now_ns();
+        uint64_t bytes;
+        int ret = replay_record(&record, &bytes);
+        add_latency(record.op, trace_now_ns() - begin, bytes);
+        if (ret < 0) {
+            stats[record.op].failed++;
+        }
+        replayed++;
+    }
+    
+    uint64_t elapsed_ns = trace_now_ns() - start_ns;
+    fflush(stdout);
+    if (saved_stdout >= 0) {
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+    
+    fclose(trace);
+    disk_close();
+    
+    if (result == -1) {
+        printf("警告: 跟踪日志在第 %d 条记录后损坏, 已停止回放\n", replayed);
+    } else if (result == -2) {
+        printf("错误: 镜像 '%s' 尚未格式化, 请使用 --fresh\n", argv[2]);
+        return 1;
+    }
+    
+    // 汇总报告
+    double seconds = elapsed_ns / 1e9;
+    uint64_t total_bytes = 0;
+    int total_count = 0;
+    int total_failed = 0;
+    for (int op = 0; op < TRACE_OP_COUNT; op++) {
+        total_bytes += stats[op].bytes;
+        total_count += stats[op].count;
+        total_failed += stats[op].failed;
+    }
+    
+    // 失败的操作 (例如读写回放镜像上不存在的文件) 不反映原始负载, 提醒使用者
+    if (total_failed > 0) {
+        printf("警告: %d 个操作执行失败 (文件不存在、已存在或空间不足), 结果可能与原始负载不符:\n", total_failed);
+        for (int op = TRACE_FORMAT; op < TRACE_OP_COUNT; op++) {
+            if (stats[op].failed > 0) {
+                printf("  %-8s 失败 %d 次\n", trace_op_name(op), stats[op].failed);
+            }
+        }
+        printf("\n");
+    }
+    
+    printf("回放 %d 个操作, 用时 %.3f 秒 (%s)\n", replayed, seconds, timed ? "按原始时间" : "尽快");
+    if (seconds > 0) {
+        printf("吞吐量: %.1f 操作/秒, %.2f MB/秒\n", replayed / seconds, total_bytes / seconds / (1024.0 * 1024.0));
+    }
+    
+    printf("\n延迟 (微秒):\n");
+    printf("  %-8s %8s %10s %10s %10s %10s %10s %10s %12s\n",
+           "op", "count", "min", "avg", "p50", "p90", "p99", "max", "bytes");
+    
+    uint64_t* all = malloc((total_count > 0 ? total_count : 1) * sizeof(uint64_t));
+    int all_count = 0;
+    for (int op = TRACE_FORMAT; op < TRACE_OP_COUNT; op++) {
+        if (all && stats[op].count > 0) {
+            memcpy(all + all_count, stats[op].latencies, stats[op].count * sizeof(uint64_t));
+            all_count += stats[op].count;
+        }
+        print_distribution(trace_op_name(op), stats[op].latencies, stats[op].count, stats[op].bytes);
+        free(stats[op].latencies);
+    }
+    if (all) {
+        print_distribution("all", all, all_count, total_bytes);
+        free(all);
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <string.h>
+#include "disk.h"
+#include "file_ops.h"
+#include "bulk_io.h"
+#include "defrag.h"
+
+/**
+ * 独立的镜像导入导出工具, 不进入交互式命令行
+ */
+static void print_usage(const char* prog) {
+    printf("用法:\n");
+    printf("  %s <镜像> format [条带单元 成员文件...] - 格式化镜像, 可条带化到多个文件\n", prog);
+    printf("  %s <镜像> import <宿主路径> [目标名]    - 导入宿主文件或目录树\n", prog);
+    printf("  %s <镜像> export <源文件名|/> <宿主路径> - 导出文件, / 表示整个镜像\n", prog);
+    printf("  %s <镜像> frag                          - 显示碎片情况\n", prog);
+    printf("  %s <镜像> defrag [毫秒数]               - 整理碎片\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    if (disk_init(argv[1]) < 0) {
+        printf("错误: 无法打开镜像 '%s'\n", argv[1]);
+        return 1;
+    }
+    
+    int ret = -1;
+    if (strcmp(argv[2], "format") == 0) {
+        if (argc >= 4 && disk_set_stripes(argc - 3, atoi(argv[3]), (const char**)argv + 4) < 0) {
+            ret = -1;
+        } else {
+            ret = format_disk();
+        }
+    } else if (fs.superblock.magic != FS_MAGIC) {
+        printf("错误: 镜像 '%s' 尚未格式化\n", argv[1]);
+    } else if (strcmp(argv[2], "import") == 0 && argc >= 4) {
+        ret = import_path(argv[3], argc >= 5 ? argv[4] : NULL);
+    } else if (strcmp(argv[2], "export") == 0 && argc >= 5) {
+        ret = export_path(argv[3], argv[4]);
+    } else if (strcmp(argv[2], "frag") == 0) {
+        ret = show_fragmentation();
+    } else if (strcmp(argv[2], "defrag") == 0) {
+        ret = defrag_disk(argc >= 4 ? atoi(argv[3]) : 0);
+    } else {
+        print_usage(argv[0]);
+    }
+    
+    disk_close();
+    return ret < 0 ? 1 : 0;
+}
@@ -4,17 +4,26 @@
 // #include <locale.h>
 #include "disk.h"
 #include "file_ops.h"
+#include "bulk_io.h"
+#include "defrag.h"
+#include "trace.h"
 
 void print_help() {
     printf("\n文件系统模拟器命令:\n");
     printf("  help            - 显示帮助信息\n");
-    printf("  format          - 格式化磁盘\n");
+    printf("  format [unit file...] - 格式化磁盘, 可指定条带单元和额外的条带成员文件\n");
     printf("  df              - 显示磁盘信息\n");
     printf("  touch <name>    - 创建文件\n");
     printf("  rm <name>       - 删除文件\n");
     printf("  ls              - 列出目录内容\n");
     printf("  cat <name>      - 读取文件内容\n");
     printf("  echo <name>     - 写入文件内容\n");
+    printf("  cp <src> <dst>  - 克隆文件 (共享数据块, 写时复制)\n");
+    printf("  import <host> [dest] - 从宿主机导入文件或目录树\n");
+    printf("  export <src|/> <host> - 导出文件到宿主机, / 表示全部文件\n");
+    printf("  frag            - 显示碎片情况\n");
+    printf("  defrag [ms]     - 整理碎片, 可限定本次运行的毫秒数\n");
+    printf("  trace <file|off> - 把文件操作记录到跟踪日志 / 结束跟踪\n");
     printf("  exit            - 退出程序\n\n");
 }
 
@@ -56,7 +65,20 @@ int main() {
         if (strcmp(cmd, "help") == 0) {
             print_help();
         } else if (strcmp(cmd, "format") == 0) {
-            format_disk();
+            // format <条带单元> <成员文件...>: 主镜像之外再把数据条带化到这些文件上
+            char* paths[MAX_STRIPES];
+            int count = 0;
+            char* token = (nargs >= 2) ? strtok(arg, " ") : NULL;
+            int unit = token ? atoi(token) : 0;
+            while (token && (token = strtok(NULL, " ")) != NULL && count < MAX_STRIPES - 1) {
+                paths[count++] = token;
+            }
+            
+            if (nargs >= 2 && disk_set_stripes(count + 1, unit, (const char**)paths) < 0) {
+                printf("用法: format [条带单元 成员文件...]\n");
+            } else {
+                format_disk();
+            }
         } else if (strcmp(cmd, "df") == 0) {
             show_disk_info();
         } else if (strcmp(cmd, "touch") == 0) {
@@ -97,6 +119,47 @@ int main() {
                     write_file(arg, buffer, strlen(buffer));
                 }
             }
+        } else if (strcmp(cmd, "cp") == 0) {
+            char src[256];
+            char dst[256];
+            if (nargs < 2 || sscanf(arg, "%255s %255s", src, dst) < 2) {
+                printf("用法: cp <源文件名> <目标文件名>\n");
+            } else {
+                clone_file(src, dst);
+            }
+        } else if (strcmp(cmd, "import") == 0) {
+            char host[256];
+            char dest[256] = "";
+            if (nargs < 2 || sscanf(arg, "%255s %255s", host, dest) < 1) {
+                printf("用法: import <宿主路径> [目标名]\n");
+            } else {
+                import_path(host, dest);
+            }
+        } else if (strcmp(cmd, "export") == 0) {
+            char src[256];
+            char host[256];
+            if (nargs < 2 || sscanf(arg, "%255s %255s", src, host) < 2) {
+                printf("用法: export <源文件名|/> <宿主路径>\n");
+            } else {
+                export_path(src, host);
+            }
+        } else if (strcmp(cmd, "frag") == 0) {
+            show_fragmentation();
+        } else if (strcmp(cmd, "defrag") == 0) {
+            int budget_ms = 0;
+            if (nargs >= 2 && (sscanf(arg, "%d", &budget_ms) < 1 || budget_ms < 0)) {
+                printf("用法: defrag [毫秒数]\n");
+            } else {
+                defrag_disk(budget_ms);
+            }
+        } else if (strcmp(cmd, "trace") == 0) {
+            if (nargs < 2) {
+                printf("用法: trace <跟踪日志|off>\n");
+            } else if (strcmp(arg, "off") == 0) {
+                trace_stop();
+            } else {
+                trace_start(arg);
+            }
         } else if (strcmp(cmd, "exit") == 0) {
             break;
         } else {
@@ -105,6 +168,7 @@ int main() {
         }
     }
     
+    trace_stop();
     disk_close();
     printf("再见!\n");
     return 0;
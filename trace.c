@@ -0,0 +1,123 @@
+#define _POSIX_C_SOURCE 200809L
+#include "trace.h"
+#include <time.h>
+
+static FILE* trace_file = NULL;        // 当前跟踪日志, NULL表示未开启
+static uint64_t trace_start_ns = 0;    // 跟踪开始的时间
+
+/**
+ * 获取单调时钟的纳秒数
+ */
+uint64_t trace_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * 开始跟踪
+ */
+int trace_start(const char* path) {
+    trace_stop();
+    
+    trace_file = fopen(path, "wb");
+    if (!trace_file) {
+        printf("错误: 无法创建跟踪日志 '%s'\n", path);
+        return -1;
+    }
+    
+    uint32_t header[2] = {TRACE_MAGIC, TRACE_VERSION};
+    fwrite(header, sizeof(header), 1, trace_file);
+    trace_start_ns = trace_now_ns();
+    
+    printf("开始跟踪文件操作, 记录到 '%s'\n", path);
+    return 0;
+}
+
+/**
+ * 结束跟踪
+ */
+void trace_stop() {
+    if (trace_file) {
+        fclose(trace_file);
+        trace_file = NULL;
+        printf("跟踪已结束\n");
+    }
+}
+
+/**
+ * 记录一次操作
+ */
+void trace_log(uint8_t op, const char* name, const char* name2, uint32_t size, uint32_t offset) {
+    if (!trace_file) {
+        return;
+    }
+    
+    uint64_t timestamp_ns = trace_now_ns() - trace_start_ns;
+    size_t name_len = name ? strnlen(name, MAX_FILENAME - 1) : 0;
+    size_t name2_len = name2 ? strnlen(name2, MAX_FILENAME - 1) : 0;
+    uint8_t head[4] = {op, (uint8_t)name_len, (uint8_t)name2_len, 0};
+    
+    fwrite(head, sizeof(head), 1, trace_file);
+    fwrite(&size, sizeof(size), 1, trace_file);
+    fwrite(&offset, sizeof(offset), 1, trace_file);
+    fwrite(&timestamp_ns, sizeof(timestamp_ns), 1, trace_file);
+    if (name_len > 0) {
+        fwrite(name, 1, name_len, trace_file);
+    }
+    if (name2_len > 0) {
+        fwrite(name2, 1, name2_len, trace_file);
+    }
+}
+
+/**
+ * 打开跟踪日志用于读取
+ */
+FILE* trace_open(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        printf("错误: 无法打开跟踪日志 '%s'\n", path);
+        return NULL;
+    }
+    
+    uint32_t header[2];
+    if (fread(header, sizeof(header), 1, file) != 1 || header[0] != TRACE_MAGIC || header[1] != TRACE_VERSION) {
+        printf("错误: '%s' 不是有效的跟踪日志\n", path);
+        fclose(file);
+        return NULL;
+    }
+    return file;
+}
+
+/**
+ * 读取下一条记录
+ */
+int trace_next(FILE* file, trace_record_t* record) {
+    uint8_t head[4];
+    if (fread(head, sizeof(head), 1, file) != 1) {
+        return 0;
+    }
+    
+    memset(record, 0, sizeof(trace_record_t));
+    record->op = head[0];
+    if (record->op < TRACE_FORMAT || record->op >= TRACE_OP_COUNT ||
+        head[1] >= MAX_FILENAME || head[2] >= MAX_FILENAME ||
+        fread(&record->size, sizeof(record->size), 1, file) != 1 ||
+        fread(&record->offset, sizeof(record->offset), 1, file) != 1 ||
+        fread(&record->timestamp_ns, sizeof(record->timestamp_ns), 1, file) != 1 ||
+        fread(record->name, 1, head[1], file) != head[1] ||
+        fread(record->name2, 1, head[2], file) != head[2]) {
+        return -1;
+    }
+    return 1;
+}
+
+/**
+ * 操作类型的名称
+ */
+const char* trace_op_name(uint8_t op) {
+    static const char* names[TRACE_OP_COUNT] = {
+        "?", "format", "create", "delete", "read", "write", "clone", "list", "defrag"
+    };
+    return op < TRACE_OP_COUNT ? names[op] : "?";
+}
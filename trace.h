@@ -0,0 +1,55 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "file_ops.h"
+
+#define TRACE_MAGIC 0x52545346         // "FSTR"
+#define TRACE_VERSION 1
+
+// 跟踪的操作类型
+enum {
+    TRACE_FORMAT = 1,
+    TRACE_CREATE,
+    TRACE_DELETE,
+    TRACE_READ,
+    TRACE_WRITE,
+    TRACE_CLONE,
+    TRACE_LIST,
+    TRACE_DEFRAG,                      // size为时间预算 (毫秒)
+    TRACE_OP_COUNT
+};
+
+// 一条跟踪记录
+// 磁盘上的格式: op(1) name_len(1) name2_len(1) 保留(1) size(4) offset(4) timestamp_ns(8),
+// 随后是两个不带结尾0的文件名
+typedef struct {
+    uint8_t op;                        // 操作类型
+    char name[MAX_FILENAME];           // 文件名
+    char name2[MAX_FILENAME];          // 第二个文件名 (仅克隆使用)
+    uint32_t size;                     // 请求的字节数
+    uint32_t offset;                   // 文件内偏移
+    uint64_t timestamp_ns;             // 相对跟踪开始的时间
+} trace_record_t;
+
+// 开始把文件操作记录到path, 已在记录时先结束之前的跟踪
+int trace_start(const char *path);
+
+// 结束跟踪并关闭日志
+void trace_stop();
+
+// 记录一次操作, 未开启跟踪时直接返回
+void trace_log(uint8_t op, const char *name, const char *name2, uint32_t size, uint32_t offset);
+
+// 打开跟踪日志用于读取, 校验文件头
+FILE *trace_open(const char *path);
+
+// 读取下一条记录, 返回1表示成功, 0表示结束, -1表示日志损坏
+int trace_next(FILE *file, trace_record_t *record);
+
+// 操作类型的名称
+const char *trace_op_name(uint8_t op);
+
+// 单调时钟的纳秒数, 跟踪时间戳、回放计时和碎片整理的时间预算共用
+uint64_t trace_now_ns();
+
+#endif